@@ -0,0 +1,344 @@
+#include "huffman.h"
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BATCH_PATH_MAX 4096  // 单个路径的最大长度
+
+// 批处理中的单个文件任务
+typedef struct {
+    char *input;  // 输入文件路径
+    char *output;  // 输出文件路径
+    char *code;  // 编码表文件路径
+    const char *status;  // 处理结果：ok、failed 或 receiver-mismatch
+    FileStats stats;  // 文件字节数与 HASH 值
+    double seconds;  // 处理耗时（秒）
+} BatchTask;
+
+// 任务列表，容量按倍数增长
+typedef struct {
+    BatchTask *tasks;
+    size_t count;
+    size_t capacity;
+} TaskList;
+
+// 工作线程自己的任务区间 [head, tail)，自己从头部取任务，其他线程从尾部窃取
+typedef struct {
+    pthread_mutex_t lock;
+    size_t head;
+    size_t tail;
+} WorkQueue;
+
+// 所有工作线程共享的线程池状态
+typedef struct {
+    BatchTask *tasks;
+    WorkQueue *queues;
+    int worker_count;
+    bool compress;  // 为真时压缩，否则解压
+    bool encrypt;
+    const char *sender;
+    const char *receiver;
+    FILE *summary;  // 汇总文件，每个任务完成后立即追加一行
+    pthread_mutex_t summary_lock;  // 保护汇总文件的写入
+} BatchPool;
+
+// 传给单个工作线程的参数
+typedef struct {
+    BatchPool *pool;
+    int id;
+} Worker;
+
+// 向任务列表追加一个任务，路径会被复制
+static int add_task(TaskList *list, const char *input, const char *output, const char *code) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        BatchTask *grown = (BatchTask *)realloc(list->tasks, capacity * sizeof(BatchTask));
+        if (grown == NULL) {
+            perror("Memory allocation failed for batch tasks");
+            return -1;
+        }
+        list->tasks = grown;
+        list->capacity = capacity;
+    }
+    BatchTask *task = &list->tasks[list->count];
+    memset(task, 0, sizeof(BatchTask));
+    task->input = strdup(input);
+    task->output = strdup(output);
+    task->code = strdup(code);
+    if (task->input == NULL || task->output == NULL || task->code == NULL) {
+        perror("Memory allocation failed for batch tasks");
+        free(task->input);
+        free(task->output);
+        free(task->code);
+        return -1;
+    }
+    list->count++;
+    return 0;
+}
+
+// 释放任务列表
+static void free_task_list(TaskList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->tasks[i].input);
+        free(list->tasks[i].output);
+        free(list->tasks[i].code);
+    }
+    free(list->tasks);
+}
+
+// 从清单文件读取任务，每行格式为“输入 输出 编码表”，空行和以 # 开头的行被忽略
+static int load_manifest(const char *filename, TaskList *list) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open batch manifest %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+    char line[3 * BATCH_PATH_MAX];
+    char input[BATCH_PATH_MAX], output[BATCH_PATH_MAX], code[BATCH_PATH_MAX];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char *start = line + strspn(line, " \t\r\n");
+        if (*start == '\0' || *start == '#')
+            continue;
+        if (sscanf(start, "%4095s %4095s %4095s", input, output, code) != 3) {
+            fprintf(stderr, "错误：清单第 %d 行格式应为'输入 输出 编码表'\n", line_number);
+            fclose(file);
+            return -1;
+        }
+        if (add_task(list, input, output, code) != 0) {
+            fclose(file);
+            return -1;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+// 判断文件名是否以指定后缀结尾
+static bool has_suffix(const char *name, const char *suffix) {
+    size_t name_length = strlen(name);
+    size_t suffix_length = strlen(suffix);
+    return name_length > suffix_length && strcmp(name + name_length - suffix_length, suffix) == 0;
+}
+
+// 按输入路径排序，使目录模式的任务顺序稳定
+static int compare_tasks(const void *a, const void *b) {
+    return strcmp(((const BatchTask *)a)->input, ((const BatchTask *)b)->input);
+}
+
+// 扫描目录生成任务：压缩时 name -> name.huf + name.code，解压时 name.huf + name.code -> name.out
+static int load_directory(const char *dirname, bool compress, TaskList *list) {
+    DIR *dir = opendir(dirname);
+    if (dir == NULL) {
+        fprintf(stderr, "Failed to open batch directory %s: %s\n", dirname, strerror(errno));
+        return -1;
+    }
+    char input[BATCH_PATH_MAX], output[BATCH_PATH_MAX], code[BATCH_PATH_MAX];
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (name[0] == '.')
+            continue;
+        if (compress && (has_suffix(name, ".huf") || has_suffix(name, ".code") || has_suffix(name, ".out")))
+            continue;  // 跳过之前批处理生成的文件
+        if (!compress && !has_suffix(name, ".huf"))
+            continue;
+        snprintf(input, sizeof(input), "%s/%s", dirname, name);
+        struct stat st;
+        if (stat(input, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        int output_length, code_length;
+        if (compress) {
+            output_length = snprintf(output, sizeof(output), "%s.huf", input);
+            code_length = snprintf(code, sizeof(code), "%s.code", input);
+        } else {
+            int base_length = (int)(strlen(input) - strlen(".huf"));
+            output_length = snprintf(output, sizeof(output), "%.*s.out", base_length, input);
+            code_length = snprintf(code, sizeof(code), "%.*s.code", base_length, input);
+        }
+        if (output_length >= (int)sizeof(output) || code_length >= (int)sizeof(code)) {
+            fprintf(stderr, "错误：路径过长，已跳过 %s\n", input);
+            continue;
+        }
+        if (add_task(list, input, output, code) != 0) {
+            closedir(dir);
+            return -1;
+        }
+    }
+    closedir(dir);
+    if (list->count > 1)  // 空目录时任务数组为 NULL，不能传给 qsort
+        qsort(list->tasks, list->count, sizeof(BatchTask), compare_tasks);
+    return 0;
+}
+
+// 取下一个任务：先取自己区间的头部，为空时从其他线程的区间尾部窃取一半
+static bool take_task(BatchPool *pool, int id, size_t *index) {
+    WorkQueue *own = &pool->queues[id];
+    pthread_mutex_lock(&own->lock);
+    if (own->head < own->tail) {
+        *index = own->head++;
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    for (int k = 1; k < pool->worker_count; k++) {
+        WorkQueue *victim = &pool->queues[(id + k) % pool->worker_count];
+        pthread_mutex_lock(&victim->lock);
+        size_t remaining = victim->tail - victim->head;
+        if (remaining == 0) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        size_t stolen_head = victim->tail - (remaining + 1) / 2;  // 至少窃取一个任务
+        size_t stolen_tail = victim->tail;
+        victim->tail = stolen_head;
+        pthread_mutex_unlock(&victim->lock);
+
+        pthread_mutex_lock(&own->lock);
+        own->head = stolen_head + 1;  // 第一个窃取到的任务立即执行，其余放入自己的区间
+        own->tail = stolen_tail;
+        pthread_mutex_unlock(&own->lock);
+        *index = stolen_head;
+        return true;
+    }
+    return false;
+}
+
+// 处理单个任务并记录结果
+static void run_task(BatchPool *pool, WorkerContext *ctx, BatchTask *task) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = pool->compress
+                     ? compress_file_ctx(ctx, task->input, task->output, task->code, pool->sender,
+                                         pool->receiver, pool->encrypt, &task->stats)
+                     : decompress_file_ctx(ctx, task->input, task->output, task->code, pool->receiver,
+                                           pool->encrypt, &task->stats);
+    task->status = result == RESULT_OK                     ? "ok"
+                   : result == RESULT_RECEIVER_MISMATCH ? "receiver-mismatch"
+                                                        : "failed";
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    task->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    // 立即写入并刷新汇总行，进程中途退出时已完成的结果不会丢失
+    pthread_mutex_lock(&pool->summary_lock);
+    fprintf(pool->summary, "%s\t%s\t%s\t%s\t%ld\t%ld\t0x%016lx\t%.6f\n", task->status, task->input,
+            task->output, task->code, task->stats.input_size, task->stats.output_size, task->stats.hash,
+            task->seconds);
+    fflush(pool->summary);
+    pthread_mutex_unlock(&pool->summary_lock);
+}
+
+// 工作线程主循环，上下文及其缓冲区在该线程处理的所有文件之间复用
+static void *worker_main(void *arg) {
+    Worker *worker = (Worker *)arg;
+    WorkerContext ctx = {0};
+    ctx.quiet = true;
+    size_t index;
+    while (take_task(worker->pool, worker->id, &index))
+        run_task(worker->pool, &ctx, &worker->pool->tasks[index]);
+    free_worker_context(&ctx);
+    return NULL;
+}
+
+// 批处理：用共享线程池处理清单文件或目录中的全部文件，并把每个文件的结果写入汇总文件
+int run_batch(const char *mode, const char *list, const char *summary, const char *sender,
+              const char *receiver, bool encrypt, int threads) {
+    bool compress = strcmp(mode, "compress") == 0;
+    if (!compress && strcmp(mode, "decompress") != 0) {
+        fprintf(stderr, "错误：批处理模式应为 compress 或 decompress\n");
+        return 1;
+    }
+
+    TaskList tasks = {NULL, 0, 0};
+    struct stat st;
+    int loaded = (stat(list, &st) == 0 && S_ISDIR(st.st_mode))
+                     ? load_directory(list, compress, &tasks)
+                     : load_manifest(list, &tasks);
+    if (loaded != 0) {
+        free_task_list(&tasks);
+        return 1;
+    }
+
+    FILE *summary_file = fopen(summary, "w");  // 先打开汇总文件，避免处理完才发现无法写入
+    if (summary_file == NULL) {
+        fprintf(stderr, "Failed to open batch summary file %s: %s\n", summary, strerror(errno));
+        free_task_list(&tasks);
+        return 1;
+    }
+
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((size_t)threads > tasks.count)
+        threads = (int)tasks.count;
+    if (threads < 1)
+        threads = 1;
+
+    BatchPool pool = {tasks.tasks, NULL, threads, compress, encrypt, sender, receiver, summary_file};
+    pthread_mutex_init(&pool.summary_lock, NULL);
+    pool.queues = (WorkQueue *)calloc(threads, sizeof(WorkQueue));
+    Worker *workers = (Worker *)calloc(threads, sizeof(Worker));
+    pthread_t *ids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    if (pool.queues == NULL || workers == NULL || ids == NULL) {
+        perror("Memory allocation failed for batch workers");
+        free(pool.queues);
+        free(workers);
+        free(ids);
+        pthread_mutex_destroy(&pool.summary_lock);
+        fclose(summary_file);
+        free_task_list(&tasks);
+        return 1;
+    }
+
+    // 任务按连续区间平均分给各线程，处理快的线程再从其他线程窃取
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&pool.queues[i].lock, NULL);
+        pool.queues[i].head = tasks.count * i / threads;
+        pool.queues[i].tail = tasks.count * (i + 1) / threads;
+        workers[i].pool = &pool;
+        workers[i].id = i;
+    }
+
+    // 汇总文件每个文件一行，以制表符分隔，按完成顺序写入
+    fprintf(summary_file, "# status\tinput\toutput\tcode\tinput_bytes\toutput_bytes\thash\tseconds\n");
+    fflush(summary_file);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int started = 0;
+    for (; started < threads; started++) {
+        if (pthread_create(&ids[started], NULL, worker_main, &workers[started]) != 0) {
+            fprintf(stderr, "错误：无法创建工作线程，使用 %d 个线程继续\n", started);
+            break;
+        }
+    }
+    if (started == 0)
+        worker_main(&workers[0]);  // 一个线程都没创建成功时在当前线程处理
+    for (int i = 0; i < started; i++)
+        pthread_join(ids[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    size_t succeeded = 0;
+    for (size_t i = 0; i < tasks.count; i++)
+        if (tasks.tasks[i].status != NULL && strcmp(tasks.tasks[i].status, "ok") == 0)
+            succeeded++;
+    pthread_mutex_destroy(&pool.summary_lock);
+    fclose(summary_file);
+
+    double total_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("批处理完成：共 %zu 个文件，成功 %zu 个，失败 %zu 个，%d 个线程，用时 %.3f秒\n", tasks.count,
+           succeeded, tasks.count - succeeded, threads, total_seconds);
+
+    int result = succeeded == tasks.count ? 0 : 1;
+    for (int i = 0; i < threads; i++)
+        pthread_mutex_destroy(&pool.queues[i].lock);
+    free(pool.queues);
+    free(workers);
+    free(ids);
+    free_task_list(&tasks);
+    return result;
+}
\ No newline at end of file
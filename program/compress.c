@@ -1,57 +1,75 @@
 #include "huffman.h"
+#include <errno.h>
 
 // 将编码表保存到文件中
-void save_code_table(CodeEntry *code_table, int size, long original_size, const char *filename) {
+// 第一行为“原始文件大小 头部信息长度”，之后每行为“字节值 编码长度 编码字节...”，编码按位左对齐，共 ceil(长度/8) 个字节
+int save_code_table(CodeEntry *code_table, int size, long original_size, size_t header_size, const char *filename) {
     FILE *file = fopen(filename, "w");  // 以写入模式打开文件
     if (file == NULL) {
-        perror("Failed to open code table file");
-        return;
+        fprintf(stderr, "Failed to open code table file %s: %s\n", filename, strerror(errno));
+        return -1;
     }
-    fprintf(file, "%ld\n", original_size);  // 写入原始文件大小
+    fprintf(file, "%ld %zu\n", original_size, header_size);  // 写入原始文件大小和头部信息长度
     for (int i = 0; i < size; i++) {
-        fprintf(file, "0x%02x %d ", code_table[i].byte, code_table[i].code_length);  // 写入字节值和编码长度
-        int padding = 8 - (code_table[i].code_length % 8);  // 计算填充位数
-        if (padding == 8) padding = 0;
-        uint8_t byte = 0;
-        for (int j = 0; j < code_table[i].code_length; j++) {
-            byte <<= 1;  // 左移一位
-            byte |= (code_table[i].code[j] == '1');  // 将编码位添加到字节中
+        fprintf(file, "0x%02x %d", code_table[i].byte, code_table[i].code_length);  // 写入字节值和编码长度
+        for (int j = 0; j < code_table[i].code_length; j += 8) {
+            uint8_t byte = 0;
+            for (int k = j; k < j + 8; k++) {
+                byte <<= 1;  // 左移一位
+                if (k < code_table[i].code_length)
+                    byte |= (code_table[i].code[k] == '1');  // 将编码位添加到字节中，不足 8 位时补零
+            }
+            fprintf(file, " 0x%02x", byte);  // 写入编码字节
         }
-        byte <<= padding;  // 填充零
-        fprintf(file, "0x%02x\n", byte);  // 写入编码字节
+        fprintf(file, "\n");
+    }
+    if (fclose(file) != 0) {  // 关闭文件
+        fprintf(stderr, "Failed to write code table file %s: %s\n", filename, strerror(errno));
+        return -1;
     }
-    fclose(file);  // 关闭文件
+    return 0;
 }
 
-// 压缩文件
-void compress_file(const char *input_file, const char *output_file, const char *code_file,
-                   const char *sender, const char *receiver, bool encrypt) {
+// 使用给定的工作线程上下文压缩文件，读入缓冲区由上下文复用
+int compress_file_ctx(WorkerContext *ctx, const char *input_file, const char *output_file, const char *code_file,
+                      const char *sender, const char *receiver, bool encrypt, FileStats *stats) {
     FILE *in = fopen(input_file, "rb");  // 以二进制读取模式打开输入文件
     if (in == NULL) {
-        perror("Failed to open input file");
-        return;
+        fprintf(stderr, "Failed to open input file %s: %s\n", input_file, strerror(errno));
+        return RESULT_FAILED;
     }
     fseek(in, 0, SEEK_END);  // 将文件指针移动到文件末尾
     long original_size = ftell(in);  // 获取文件大小
     fseek(in, 0, SEEK_SET);  // 将文件指针移动到文件开头
+    if (original_size < 0) {
+        fprintf(stderr, "Failed to read input file %s: %s\n", input_file, strerror(errno));
+        fclose(in);
+        return RESULT_FAILED;
+    }
 
     char header[256];  // 定义头部信息缓冲区
     snprintf(header, sizeof(header), "发件人：%s\n收件人：%s\n", sender, receiver);  // 格式化头部信息
     size_t header_size = strlen(header);  // 获取头部信息长度
 
-    uint8_t *data = (uint8_t *)malloc(header_size + original_size);  // 分配内存用于存储数据和头部信息
+    uint8_t *data = reserve_buffer(&ctx->buffer, &ctx->capacity, header_size + original_size);  // 复用上下文缓冲区存储数据和头部信息
     if (data == NULL) {
-        perror("Memory allocation failed");
+        fprintf(stderr, "Memory allocation failed for %s: %s\n", input_file, strerror(errno));
         fclose(in);
-        return;
+        return RESULT_FAILED;
     }
-    fread(data + header_size, 1, original_size, in);  // 读取文件内容到数据缓冲区
+    size_t read_size = fread(data + header_size, 1, original_size, in);  // 读取文件内容到数据缓冲区
     fclose(in);  // 关闭输入文件
+    if (read_size != (size_t)original_size) {
+        fprintf(stderr, "Failed to read input file %s: short read\n", input_file);
+        return RESULT_FAILED;
+    }
     memcpy(data, header, header_size);  // 将头部信息复制到数据缓冲区
 
-    CodeEntry original_code_table[256] = {0};
-    if (encrypt) {
+    // 原始编码表只用于显示加密前后的编码差异，静默模式（批处理）下不显示，也就不必生成
+    CodeEntry original_code_table[256];
+    if (encrypt && !ctx->quiet) {
         printf("启用0x55偏移加密，新编码表生成中...\n");
+        memset(original_code_table, 0, sizeof(original_code_table));
         // 先统计原始频率和生成原始编码表
         Frequency freq[256] = {0};
         for (size_t i = 0; i < header_size + original_size; i++)
@@ -66,11 +84,14 @@ void compress_file(const char *input_file, const char *output_file, const char *
             }
         heap_sort(unique_freq, n);
         HuffmanNode *original_root = build_huffman_tree(unique_freq, n);
-        char **original_codes = (char **)malloc(256 * sizeof(char *));
-        generate_codes(original_root, original_codes, 0, original_code_table);
-        // 加密
-        encrypt_bytes(data, header_size + original_size, 0x55);
+        if (original_root == NULL)
+            return RESULT_FAILED;
+        char path[256];
+        generate_codes(original_root, path, 0, original_code_table);
+        free_huffman_tree(original_root);
     }
+    if (encrypt)
+        encrypt_bytes(data, header_size + original_size, 0x55);  // 加密
 
     Frequency freq[256] = {0};  // 初始化频率数组
     for (size_t i = 0; i < header_size + original_size; i++)
@@ -86,68 +107,83 @@ void compress_file(const char *input_file, const char *output_file, const char *
         }
     heap_sort(unique_freq, n);  // 对唯一字节的频率数组进行排序
     HuffmanNode *root = build_huffman_tree(unique_freq, n);  // 构建哈夫曼树
-    if (root == NULL) {
-        free(data);
-        return;
-    }
+    if (root == NULL)
+        return RESULT_FAILED;
 
     // 计算并显示哈夫曼树WPL
     uint64_t wpl = calculate_wpl(root, 0);
-    printf("霍夫曼树WPL: %lu\n", wpl);
+    if (!ctx->quiet)
+        printf("霍夫曼树WPL: %lu\n", wpl);
 
-    char **codes = (char **)malloc(256 * sizeof(char *));  // 分配内存用于存储编码
-    if (codes == NULL) {
-        perror("Memory allocation failed for codes");
-        free(data);
-        return;
-    }
-    CodeEntry code_table[256];  // 编码表
-    generate_codes(root, codes, 0, code_table);  // 生成编码表
+    char path[256];  // 生成编码时从根到当前节点的路径
+    CodeEntry code_table[256] = {0};  // 编码表
+    generate_codes(root, path, 0, code_table);  // 生成编码表
+    free_huffman_tree(root);  // 释放哈夫曼树内存
 
-    if (encrypt) {
+    if (encrypt && !ctx->quiet) {
         show_code_table_diff(original_code_table, code_table);
     }
 
-    save_code_table(code_table, n, original_size, code_file);  // 保存编码表到文件
+    int status = save_code_table(code_table, n, original_size, header_size, code_file);  // 保存编码表到文件
 
-    FILE *out = fopen(output_file, "wb");  // 以二进制写入模式打开输出文件
+    FILE *out = status == RESULT_OK ? fopen(output_file, "wb") : NULL;  // 以二进制写入模式打开输出文件
     if (out == NULL) {
-        perror("Failed to open output file");
-        free(data);
-        return;
+        if (status == RESULT_OK)
+            fprintf(stderr, "Failed to open output file %s: %s\n", output_file, strerror(errno));
+        return RESULT_FAILED;
     }
-    uint8_t *compressed_data = NULL;
-    int compressed_bit_count = 0;
+
+    // WPL 即编码后的总位数，一次性预留输出缓冲区
+    ctx->bit_count = 0;  // 重置上一个文件留下的位计数
+    if (reserve_buffer(&ctx->output, &ctx->output_capacity, (wpl + 7) / 8 + 1) == NULL) {
+        fprintf(stderr, "Memory allocation failed for output of %s: %s\n", input_file, strerror(errno));
+        fclose(out);
+        return RESULT_FAILED;
+    }
+    CodeEntry *lookup[256] = {0};  // 字节值到编码表条目的映射
+    for (int j = 0; j < n; j++)
+        lookup[code_table[j].byte] = &code_table[j];
     for (size_t i = 0; i < header_size + original_size; i++) {
-        for (int j = 0; j < n; j++)
-            if (code_table[j].byte == data[i]) {
-                for (int k = 0; k < code_table[j].code_length; k++)
-                    append_bit(&compressed_data, &compressed_bit_count, (code_table[j].code[k] == '1'));  // 将编码位添加到缓冲区
-                break;
-            }
+        CodeEntry *entry = lookup[data[i]];
+        for (int k = 0; k < entry->code_length; k++)
+            append_bit(ctx, (entry->code[k] == '1'));  // 将编码位添加到缓冲区
     }
-    flush_buffer(&compressed_data, &compressed_bit_count, out);
+    flush_buffer(ctx, out);
+    uint8_t *compressed_data = ctx->output;
 
     // 显示压缩后字节数和最后16字节
     long compressed_size = ftell(out);
-    printf("压缩后字节数: %ld\n", compressed_size);
-    printf("最后16字节HEX值: ");
-    for (int i = 0; i < (compressed_size < 16 ? compressed_size : 16); i++) {
-        printf("0x%02x ", compressed_data[compressed_size - (compressed_size < 16 ? compressed_size : 16) + i]);
+    if (!ctx->quiet) {
+        printf("压缩后字节数: %ld\n", compressed_size);
+        printf("最后16字节HEX值: ");
+        for (int i = 0; i < (compressed_size < 16 ? compressed_size : 16); i++) {
+            printf("0x%02x ", compressed_data[compressed_size - (compressed_size < 16 ? compressed_size : 16) + i]);
+        }
+        printf("\n");
     }
-    printf("\n");
 
     // 计算并显示压缩文本HASH值
     uint64_t hash = fnv1a_64(compressed_data, compressed_size);
-    printf("压缩文本HASH值: 0x%016lx\n", hash);
+    if (!ctx->quiet)
+        printf("压缩文本HASH值: 0x%016lx\n", hash);
 
-    fclose(out);  // 关闭输出文件
-    free(data);  // 释放数据缓冲区内存
-    // 释放编码表内存
-    for (int i = 0; i < n; i++) {
-        free(code_table[i].code);
+    if (fclose(out) != 0) {  // 关闭输出文件
+        fprintf(stderr, "Failed to write output file %s: %s\n", output_file, strerror(errno));
+        status = RESULT_FAILED;
     }
-    free(codes);
-    // 释放哈夫曼树内存
-    free(root);
+    stats->input_size = original_size;
+    stats->output_size = compressed_size;
+    stats->hash = hash;
+
+    return status;
+}
+
+// 压缩文件
+int compress_file(const char *input_file, const char *output_file, const char *code_file,
+                  const char *sender, const char *receiver, bool encrypt) {
+    WorkerContext ctx = {0};
+    FileStats stats;
+    int status = compress_file_ctx(&ctx, input_file, output_file, code_file, sender, receiver, encrypt, &stats);
+    free_worker_context(&ctx);
+    return status;
 }    
\ No newline at end of file
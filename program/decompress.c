@@ -1,103 +1,180 @@
 #include "huffman.h"
+#include <errno.h>
 #include <time.h>  // 添加头文件
 
-// 从文件中加载编码表
-DecodeEntry *load_code_table(const char *filename, long *original_size) {
+// 从文件中加载编码表到 table（至少 256 条），返回编码表条目数，格式错误时返回 -1
+int load_code_table(const char *filename, DecodeEntry *table, long *original_size, long *header_size) {
     FILE *file = fopen(filename, "r");  // 以读取模式打开文件
     if (file == NULL) {
-        perror("Failed to open code table file");
-        return NULL;
+        fprintf(stderr, "Failed to open code table file %s: %s\n", filename, strerror(errno));
+        return -1;
     }
-    fscanf(file, "%ld\n", original_size);  // 读取原始文件大小
-    DecodeEntry *table = (DecodeEntry *)malloc(256 * sizeof(DecodeEntry));  // 分配内存用于存储解码表
-    if (table == NULL) {
-        perror("Memory allocation failed");
+    // 读取原始文件大小和头部信息长度，头部信息最长 255 字节
+    if (fscanf(file, "%ld %ld\n", original_size, header_size) != 2 || *original_size < 0 ||
+        *header_size <= 0 || *header_size >= 256) {
+        fprintf(stderr, "错误：编码表文件 %s 第 1 行格式错误\n", filename);
         fclose(file);
-        return NULL;
+        return -1;
     }
     int index = 0;  // 解码表的索引
+    int line_number = 1;  // 当前行号，用于报告格式错误
     char line[256];  // 读取行的缓冲区
     while (fgets(line, sizeof(line), file)) {
+        line_number++;
         uint8_t byte;  // 字节值
         int code_length;  // 编码长度
-        uint8_t bits[16];  // 编码字节数组
-        sscanf(line, "0x%02hhx %d ", &byte, &code_length);  // 修改格式说明符
-        char *ptr = strstr(line, "0x");  // 查找编码字节的起始位置
-        int count = 0;  // 编码字节的数量
-        while (ptr) {
-            uint8_t b;
-            sscanf(ptr, "0x%02x", &b);  // 读取编码字节
-            bits[count++] = b;
-            ptr = strstr(ptr + 3, "0x");  // 查找下一个编码字节的起始位置
+        int consumed = 0;  // 字节值和编码长度占用的字符数
+        bool valid = index < 256 && sscanf(line, "0x%2hhx %d%n", &byte, &code_length, &consumed) == 2 &&
+                     code_length > 0 && code_length <= 128;  // 编码最长 128 位，即 16 个编码字节
+        char *ptr = line + consumed;  // 编码字节紧跟在编码长度之后
+        int bytes = 0;  // 编码字节的数量
+        uint8_t b;
+        int length;
+        while (valid && bytes < 16 && sscanf(ptr, " 0x%2hhx%n", &b, &length) == 1) {
+            table[index].bits[bytes++] = b;  // 读取编码字节
+            ptr += length;
+        }
+        // 编码字节数必须恰好为 ceil(编码长度/8)，且行内没有多余内容
+        if (!valid || bytes != (code_length + 7) / 8 || ptr[strspn(ptr, " \t\r\n")] != '\0') {
+            fprintf(stderr, "错误：编码表文件 %s 第 %d 行格式错误\n", filename, line_number);
+            fclose(file);
+            return -1;
         }
         table[index].byte = byte;  // 设置字节值
         table[index].code_length = code_length;  // 设置编码长度
-        memcpy(table[index].bits, bits, count);  // 复制编码字节数组
         index++;  // 索引加 1
     }
     fclose(file);  // 关闭文件
-    return table;
+    if (index == 0) {
+        fprintf(stderr, "错误：编码表文件 %s 为空\n", filename);
+        return -1;
+    }
+    return index;
 }
 
-// 解压缩文件
-void decompress_file(const char *input_file, const char *output_file, const char *code_file,
-                     bool decrypt) {
+// 使用给定的工作线程上下文解压缩文件，读入缓冲区、解码表和输出缓冲区由上下文复用
+// 解码出头部信息和原始内容后先解密，再核对头部中的接收人信息，最后只把原始内容写入输出文件
+int decompress_file_ctx(WorkerContext *ctx, const char *input_file, const char *output_file, const char *code_file,
+                        const char *receiver, bool decrypt, FileStats *stats) {
     clock_t start_time = clock();  // 记录解码开始时间
 
     long original_size;  // 原始文件大小
-    DecodeEntry *table = load_code_table(code_file, &original_size);  // 加载编码表
-    if (table == NULL) return;
+    long header_size;  // 头部信息长度
+    if (ctx->table == NULL) {
+        ctx->table = (DecodeEntry *)malloc(256 * sizeof(DecodeEntry));  // 解码表只分配一次
+        if (ctx->table == NULL) {
+            fprintf(stderr, "Memory allocation failed for %s: %s\n", code_file, strerror(errno));
+            return RESULT_FAILED;
+        }
+    }
+    int count = load_code_table(code_file, ctx->table, &original_size, &header_size);  // 加载编码表
+    if (count < 0) return RESULT_FAILED;
 
     FILE *in = fopen(input_file, "rb");  // 以二进制读取模式打开输入文件
     if (in == NULL) {
-        perror("Failed to open input file");
-        free(table);
-        return;
+        fprintf(stderr, "Failed to open input file %s: %s\n", input_file, strerror(errno));
+        return RESULT_FAILED;
     }
     fseek(in, 0, SEEK_END);  // 将文件指针移动到文件末尾
     long file_size = ftell(in);  // 获取文件大小
     fseek(in, 0, SEEK_SET);  // 将文件指针移动到文件开头
-    uint8_t *data = (uint8_t *)malloc(file_size);  // 分配内存用于存储压缩数据
+    if (file_size <= 0) {  // 头部信息至少编码为 1 个字节，空文件一定是截断的
+        if (file_size < 0)
+            fprintf(stderr, "Failed to read input file %s: %s\n", input_file, strerror(errno));
+        else
+            fprintf(stderr, "错误：压缩文件 %s 为空或已截断\n", input_file);
+        fclose(in);
+        return RESULT_FAILED;
+    }
+    uint8_t *data = reserve_buffer(&ctx->buffer, &ctx->capacity, file_size);  // 复用上下文缓冲区存储压缩数据
     if (data == NULL) {
-        perror("Memory allocation failed");
+        fprintf(stderr, "Memory allocation failed for %s: %s\n", input_file, strerror(errno));
         fclose(in);
-        free(table);
-        return;
+        return RESULT_FAILED;
     }
-    fread(data, 1, file_size, in);  // 读取压缩数据到缓冲区
+    size_t read_size = fread(data, 1, file_size, in);  // 读取压缩数据到缓冲区
     fclose(in);  // 关闭输入文件
-
-    if (decrypt)
-        decrypt_bytes(data, file_size, 0x55);  // 对数据进行解密
-
-    FILE *out = fopen(output_file, "wb");  // 以二进制写入模式打开输出文件
-    if (out == NULL) {
-        perror("Failed to open output file");
-        free(data);
-        free(table);
-        return;
+    if (read_size != (size_t)file_size) {
+        fprintf(stderr, "Failed to read input file %s: short read\n", input_file);
+        return RESULT_FAILED;
     }
 
-    HuffmanNode *decode_root = build_decode_tree(table, 256);  // 构建解码树
+    size_t total = (size_t)header_size + (size_t)original_size;  // 应解码出的字节数
+    uint8_t *decoded = reserve_buffer(&ctx->output, &ctx->output_capacity, total);  // 复用输出缓冲区存放解码结果
+    HuffmanNode *decode_root = build_decode_tree(ctx->table, count);  // 构建解码树
+    if (decoded == NULL || decode_root == NULL) {
+        fprintf(stderr, "Memory allocation failed for %s: %s\n", input_file, strerror(errno));
+        free_huffman_tree(decode_root);
+        return RESULT_FAILED;
+    }
 
-    int bit_pos = 0;  // 位位置
+    // 只解码头部信息和原始内容，末尾的填充位被忽略
+    size_t produced = 0;  // 已解码的字节数
+    long bit_pos = 0;  // 位位置
     HuffmanNode *current = decode_root;
-    while (bit_pos < file_size * 8) {
+    while (produced < total && bit_pos < file_size * 8) {
         int bit = (data[bit_pos / 8] >> (7 - (bit_pos % 8))) & 1;
         current = bit ? current->right : current->left;
+        bit_pos++;
+        if (current == NULL)  // 编码表中没有对应的编码，数据已损坏
+            break;
         if (!current->left && !current->right) {
-            fputc(current->byte, out);
+            decoded[produced++] = current->byte;
             current = decode_root;
         }
-        bit_pos++;
+    }
+    free_huffman_tree(decode_root);  // 释放解码树内存
+
+    int status = RESULT_OK;
+    if (produced != total || (bit_pos + 7) / 8 != file_size) {
+        fprintf(stderr, "错误：%s 的解码长度与编码表 %s 记录的大小不符\n", input_file, code_file);
+        status = RESULT_FAILED;
+    }
+
+    if (status == RESULT_OK && decrypt)
+        decrypt_bytes(decoded, total, 0x55);  // 加密作用于编码前的数据，因此在解码之后解密
+
+    // 头部信息以“收件人：接收人\n”结尾
+    if (status == RESULT_OK && receiver != NULL) {
+        char expected[256];
+        int expected_length = snprintf(expected, sizeof(expected), "收件人：%s\n", receiver);
+        if (expected_length >= (int)sizeof(expected) || expected_length > header_size ||
+            memcmp(decoded + header_size - expected_length, expected, expected_length) != 0)
+            status = RESULT_RECEIVER_MISMATCH;
+    }
+
+    if (status == RESULT_OK) {
+        FILE *out = fopen(output_file, "wb");  // 以二进制写入模式打开输出文件
+        if (out == NULL) {
+            fprintf(stderr, "Failed to open output file %s: %s\n", output_file, strerror(errno));
+            status = RESULT_FAILED;
+        } else {
+            fwrite(decoded + header_size, 1, original_size, out);  // 跳过头部信息，只写入原始内容
+            if (fclose(out) != 0) {  // 关闭输出文件
+                fprintf(stderr, "Failed to write output file %s: %s\n", output_file, strerror(errno));
+                status = RESULT_FAILED;
+            }
+        }
     }
 
     // 显示解码时间
     clock_t end_time = clock();
     double decode_time = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
-    printf("解码时间: %.3f秒\n", decode_time);
+    if (!ctx->quiet)
+        printf("解码时间: %.3f秒\n", decode_time);
 
-    fclose(out);  // 关闭输出文件
-    free(data);  // 释放数据缓冲区内存
-    free(table);  // 释放解码表内存
+    stats->input_size = file_size;
+    stats->output_size = status == RESULT_OK ? original_size : 0;
+    stats->hash = 0;
+    return status;
+}
+
+// 解压缩文件
+int decompress_file(const char *input_file, const char *output_file, const char *code_file,
+                    const char *receiver, bool decrypt) {
+    WorkerContext ctx = {0};
+    FileStats stats;
+    int status = decompress_file_ctx(&ctx, input_file, output_file, code_file, receiver, decrypt, &stats);
+    free_worker_context(&ctx);
+    return status;
 }
\ No newline at end of file
@@ -137,29 +137,23 @@ HuffmanNode *build_huffman_tree(Frequency freq[], int n) {
     return root;
 }
 
-// 生成哈夫曼编码表
-void generate_codes(HuffmanNode *root, char **codes, int top, CodeEntry *code_table) {
-    static int index = 0;  // 编码表的索引
+// 生成哈夫曼编码表，path 存放从根到当前节点的路径，至少 256 字节
+void generate_codes(HuffmanNode *root, char *path, int top, CodeEntry *code_table) {
+    static _Thread_local int index = 0;  // 编码表的索引，每个线程独立一份
+    if (top == 0) index = 0;  // 从根节点开始时重置索引
     if (root->left) {
-        codes[top] = (char *)malloc(2);  // 分配内存
-        codes[top][0] = '0';
-        codes[top][1] = '\0';
-        generate_codes(root->left, codes, top + 1, code_table);  // 递归生成左子树的编码
+        path[top] = '0';
+        generate_codes(root->left, path, top + 1, code_table);  // 递归生成左子树的编码
     }
     if (root->right) {
-        codes[top] = (char *)malloc(2);  // 分配内存
-        codes[top][0] = '1';
-        codes[top][1] = '\0';
-        generate_codes(root->right, codes, top + 1, code_table);  // 递归生成右子树的编码
+        path[top] = '1';
+        generate_codes(root->right, path, top + 1, code_table);  // 递归生成右子树的编码
     }
     if (!root->left && !root->right) {  // 如果是叶子节点
+        if (top == 0)  // 整棵树只有一个叶子时使用 1 位编码 "0"，保证解码时每个字节至少消耗 1 位
+            path[top++] = '0';
         code_table[index].byte = root->byte;  // 设置字节值
-        code_table[index].code = (char *)malloc((top + 1) * sizeof(char));  // 为编码分配内存
-        if (code_table[index].code == NULL) {
-            perror("Memory allocation failed for code");
-            return;
-        }
-        strncpy(code_table[index].code, codes[top], top);  // 复制编码
+        memcpy(code_table[index].code, path, top);  // 复制从根到叶子路径上的每一位
         code_table[index].code[top] = '\0';  // 字符串结束符
         code_table[index].code_length = top;  // 设置编码长度
         index++;  // 索引加 1
@@ -191,29 +185,50 @@ uint64_t fnv1a_64(const void *data, size_t length) {
     return hash;
 }
 
-// 向缓冲区追加一个位
-void append_bit(uint8_t **buffer, int *bit_count, int bit) {
-    if (*bit_count == 8) {  // 如果缓冲区已满
-        *buffer = (uint8_t *)realloc(*buffer, (*buffer ? 1 : 0) + 1);  // 重新分配内存
-        if (*buffer == NULL) {
+// 向输出缓冲区追加一个位
+void append_bit(WorkerContext *ctx, int bit) {
+    size_t byte_index = ctx->bit_count / 8;  // 当前位所在的字节
+    if (ctx->bit_count % 8 == 0) {  // 需要开始一个新字节
+        if (reserve_buffer(&ctx->output, &ctx->output_capacity, byte_index + 1) == NULL) {
             perror("Memory allocation failed for buffer");
             return;
         }
-        **buffer = 0;  // 清空缓冲区
-        *bit_count = 0;  // 重置位计数器
+        ctx->output[byte_index] = 0;  // 清空新字节
     }
     if (bit)
-        (*buffer)[0] |= (1 << (7 - *bit_count));  // 将位添加到缓冲区
-    (*bit_count)++;  // 位计数器加 1
+        ctx->output[byte_index] |= (1 << (7 - ctx->bit_count % 8));  // 将位添加到缓冲区
+    ctx->bit_count++;  // 位计数器加 1
 }
 
-// 将缓冲区的内容刷新到文件
-void flush_buffer(uint8_t **buffer, int *bit_count, FILE *file) {
-    if (*bit_count > 0) {  // 如果缓冲区有数据
-        fwrite(buffer, 1, 1, file);  // 将缓冲区的内容写入文件
-        *buffer = NULL;  // 清空缓冲区指针
-        *bit_count = 0;  // 重置位计数器
+// 将输出缓冲区的内容刷新到文件，最后一个字节不足 8 位时补零
+void flush_buffer(WorkerContext *ctx, FILE *file) {
+    if (ctx->bit_count > 0)  // 如果缓冲区有数据
+        fwrite(ctx->output, 1, (ctx->bit_count + 7) / 8, file);
+}
+
+// 确保缓冲区至少能容纳 size 字节，size 为 0 时也保证返回已分配的缓冲区
+uint8_t *reserve_buffer(uint8_t **buffer, size_t *capacity, size_t size) {
+    if (size > *capacity || *buffer == NULL) {
+        size_t grown_capacity = *capacity ? *capacity : 4096;
+        while (grown_capacity < size)
+            grown_capacity *= 2;  // 按倍数增长，减少重复分配
+        uint8_t *grown = (uint8_t *)realloc(*buffer, grown_capacity);
+        if (grown == NULL)
+            return NULL;
+        *buffer = grown;
+        *capacity = grown_capacity;
     }
+    return *buffer;
+}
+
+// 释放工作线程上下文持有的缓冲区
+void free_worker_context(WorkerContext *ctx) {
+    free(ctx->buffer);
+    free(ctx->output);
+    free(ctx->table);
+    ctx->buffer = ctx->output = NULL;
+    ctx->table = NULL;
+    ctx->capacity = ctx->output_capacity = ctx->bit_count = 0;
 }
 
 // 对字节数据进行加密
@@ -241,7 +256,7 @@ void show_code_table_diff(CodeEntry *original, CodeEntry *new_table) {
     // 这里简单示例，可根据实际情况完善
     printf("编码表差异显示：\n");
     for (int i = 0; i < 256; i++) {
-        if (original[i].code && new_table[i].code) {
+        if (original[i].code_length && new_table[i].code_length) {
             if (strcmp(original[i].code, new_table[i].code) != 0) {
                 printf("Byte 0x%02x: 原编码 %s, 新编码 %s\n", original[i].byte, original[i].code, new_table[i].code);
             }
@@ -252,23 +267,30 @@ void show_code_table_diff(CodeEntry *original, CodeEntry *new_table) {
 // 构建解码树
 HuffmanNode *build_decode_tree(DecodeEntry *table, int n) {
     HuffmanNode *root = create_huffman_node(0, 0);
+    if (root == NULL) return NULL;
     for (int i = 0; i < n; i++) {
         HuffmanNode *current = root;
         for (int j = 0; j < table[i].code_length; j++) {
             int bit = (table[i].bits[j / 8] >> (7 - (j % 8))) & 1;
-            if (bit) {
-                if (!current->right) {
-                    current->right = create_huffman_node(0, 0);
-                }
-                current = current->right;
-            } else {
-                if (!current->left) {
-                    current->left = create_huffman_node(0, 0);
+            HuffmanNode **child = bit ? &current->right : &current->left;
+            if (!*child) {
+                *child = create_huffman_node(0, 0);
+                if (*child == NULL) {
+                    free_huffman_tree(root);
+                    return NULL;
                 }
-                current = current->left;
             }
+            current = *child;
         }
         current->byte = table[i].byte;
     }
     return root;
+}
+
+// 释放整棵哈夫曼树
+void free_huffman_tree(HuffmanNode *root) {
+    if (!root) return;
+    free_huffman_tree(root->left);
+    free_huffman_tree(root->right);
+    free(root);
 }
\ No newline at end of file
@@ -11,6 +11,11 @@
 #define FNV1A_64_INIT 0xcbf29ce484222325ULL
 #define FNV1A_64_PRIME 0x100000001b3ULL
 
+// 压缩/解压函数的返回值
+#define RESULT_OK 0  // 成功
+#define RESULT_FAILED (-1)  // 失败
+#define RESULT_RECEIVER_MISMATCH (-2)  // 解码出的接收人信息不匹配
+
 // 用于统计每个字节出现频率的结构体
 typedef struct {
     uint8_t byte;  // 字节值
@@ -34,7 +39,7 @@ typedef struct {
 // 编码表条目的结构体
 typedef struct {
     uint8_t byte;  // 字节值
-    char *code;  // 该字节对应的哈夫曼编码
+    char code[256];  // 该字节对应的哈夫曼编码，256 个字节值的树深度不超过 255
     int code_length;  // 编码的长度
 } CodeEntry;
 
@@ -45,6 +50,24 @@ typedef struct {
     uint8_t bits[16];  // 编码字节数组，最多支持 128 位编码
 } DecodeEntry;
 
+// 工作线程上下文，批处理时在多个文件之间复用，用完后调用 free_worker_context 释放
+typedef struct {
+    uint8_t *buffer;  // 复用的读入缓冲区
+    size_t capacity;  // 读入缓冲区的容量
+    uint8_t *output;  // 复用的输出缓冲区：压缩时存放编码位，解压时存放解码字节
+    size_t output_capacity;  // 输出缓冲区的容量
+    size_t bit_count;  // 输出缓冲区中已写入的位数，每个文件开始时清零
+    DecodeEntry *table;  // 复用的解码表，共 256 条
+    bool quiet;  // 为真时不打印单个文件的处理信息
+} WorkerContext;
+
+// 单个文件的处理结果
+typedef struct {
+    long input_size;  // 输入文件字节数
+    long output_size;  // 输出文件字节数
+    uint64_t hash;  // 压缩文本 HASH 值，仅压缩时有效
+} FileStats;
+
 // 堆操作函数声明
 MinHeap *create_min_heap(int capacity);  // 创建一个指定容量的最小堆
 void swap_nodes(HuffmanNode **a, HuffmanNode **b);  // 交换两个哈夫曼节点指针
@@ -56,8 +79,9 @@ MinHeap *build_min_heap(Frequency freq[], int n);  // 根据频率数组构建
 // 哈夫曼树操作函数声明
 HuffmanNode *create_huffman_node(uint8_t byte, uint64_t frequency);  // 创建一个哈夫曼树节点
 HuffmanNode *build_huffman_tree(Frequency freq[], int n);  // 根据频率数组构建哈夫曼树
-void generate_codes(HuffmanNode *root, char **codes, int top, CodeEntry *code_table);  // 生成哈夫曼编码表
+void generate_codes(HuffmanNode *root, char *path, int top, CodeEntry *code_table);  // 生成哈夫曼编码表
 HuffmanNode *build_decode_tree(DecodeEntry *table, int n);  // 构建解码树
+void free_huffman_tree(HuffmanNode *root);  // 释放整棵哈夫曼树
 
 // 堆排序函数声明
 void heap_sort(Frequency arr[], int n);  // 对频率数组进行堆排序
@@ -66,8 +90,10 @@ void heap_sort(Frequency arr[], int n);  // 对频率数组进行堆排序
 uint64_t fnv1a_64(const void *data, size_t length);  // 计算 FNV-1a 64 位哈希值
 
 // 位操作函数声明
-void append_bit(uint8_t **buffer, int *bit_count, int bit);  // 向缓冲区追加一个位
-void flush_buffer(uint8_t **buffer, int *bit_count, FILE *file);  // 将缓冲区的内容刷新到文件
+void append_bit(WorkerContext *ctx, int bit);  // 向输出缓冲区追加一个位
+void flush_buffer(WorkerContext *ctx, FILE *file);  // 将输出缓冲区的内容刷新到文件
+uint8_t *reserve_buffer(uint8_t **buffer, size_t *capacity, size_t size);  // 确保缓冲区至少能容纳 size 字节
+void free_worker_context(WorkerContext *ctx);  // 释放工作线程上下文持有的缓冲区
 
 // 扩展功能函数声明
 void encrypt_bytes(uint8_t *data, size_t length, uint8_t offset);  // 对字节数据进行加密
@@ -79,4 +105,14 @@ uint64_t calculate_wpl(HuffmanNode *root, int depth);
 // 新增：显示编码表差异
 void show_code_table_diff(CodeEntry *original, CodeEntry *new_table);
 
+// 压缩/解压函数声明，返回 RESULT_* 之一
+int compress_file_ctx(WorkerContext *ctx, const char *input_file, const char *output_file, const char *code_file,
+                      const char *sender, const char *receiver, bool encrypt, FileStats *stats);
+int decompress_file_ctx(WorkerContext *ctx, const char *input_file, const char *output_file, const char *code_file,
+                        const char *receiver, bool decrypt, FileStats *stats);  // receiver 为 NULL 时不核对接收人
+
+// 批处理：用共享线程池处理清单文件或目录中的全部文件
+int run_batch(const char *mode, const char *list, const char *summary, const char *sender,
+              const char *receiver, bool encrypt, int threads);
+
 #endif    
\ No newline at end of file
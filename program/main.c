@@ -3,10 +3,50 @@
 // 打印程序使用说明
 void usage() {
     printf("Usage: program [compress|decompress] input output code sender receiver [encrypt]\n");
+    printf("       program batch [compress|decompress] manifest|directory summary sender receiver [encrypt] [threads]\n");
+}
+
+// 检查附加信息格式（学号,姓名）
+bool check_party_info(const char *sender, const char *receiver) {
+    if (strlen(sender) < 12 || strchr(sender, ',') == NULL ||
+        strlen(receiver) < 12 || strchr(receiver, ',') == NULL) {
+        fprintf(stderr, "错误：发送人/接收人信息格式应为'学号,姓名'\n");
+        return false;
+    }
+    return true;
+}
+
+// 批处理入口：附加信息只检查一次，之后所有文件共享同一个进程和线程池
+int batch_main(int argc, char *argv[]) {
+    if (argc < 7) {
+        usage();
+        return 1;
+    }
+    if (!check_party_info(argv[5], argv[6]))
+        return 1;
+    bool encrypt = false;  // 是否加密
+    int threads = 0;  // 线程数，省略或为 0 时使用全部 CPU 核心
+    for (int i = 7; i < argc; i++) {
+        if (strcmp(argv[i], "encrypt") == 0) {
+            encrypt = true;
+            continue;
+        }
+        char *end;
+        long value = strtol(argv[i], &end, 10);
+        if (end == argv[i] || *end != '\0' || value < 0 || value > 4096) {  // 拒绝 4abc 这类带多余字符的参数
+            usage();
+            return 1;
+        }
+        threads = (int)value;
+    }
+    return run_batch(argv[2], argv[3], argv[4], argv[5], argv[6], encrypt, threads);
 }
 
 // 主函数
 int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "batch") == 0)
+        return batch_main(argc, argv);  // 批处理模式
+
     if (argc < 6) {
         usage();  // 如果参数数量不足，打印使用说明
         return 1;
@@ -21,33 +61,28 @@ int main(int argc, char *argv[]) {
     char *receiver = argv[6];  // 接收者信息
 
     // 检查附加信息格式（学号,姓名）
-    if (strlen(sender) < 12 || strchr(sender, ',') == NULL ||
-        strlen(receiver) < 12 || strchr(receiver, ',') == NULL) {
-        fprintf(stderr, "错误：发送人/接收人信息格式应为'学号,姓名'\n");
+    if (!check_party_info(sender, receiver))
         return 1;
-    }
 
     // 添加函数声明
-    void compress_file(const char *input_file, const char *output_file, const char *code_file, const char *sender, const char *receiver, bool encrypt);
-    void decompress_file(const char *input_file, const char *output_file, const char *code_file, bool decrypt);
+    int compress_file(const char *input_file, const char *output_file, const char *code_file, const char *sender, const char *receiver, bool encrypt);
+    int decompress_file(const char *input_file, const char *output_file, const char *code_file, const char *receiver, bool decrypt);
 
     if (strcmp(mode, "compress") == 0) {
-        compress_file(input, output, code_file, sender, receiver, encrypt);  // 调用压缩函数
+        if (compress_file(input, output, code_file, sender, receiver, encrypt) != RESULT_OK)  // 调用压缩函数
+            return 1;
         printf("Compression successful!\n");  // 打印压缩成功信息
     } else if (strcmp(mode, "decompress") == 0) {
-        // 核对接收人信息
-        FILE *temp = fopen(input, "rb");
-        char header[256];
-        fread(header, 1, 256, temp);
-        if (strstr(header, receiver) == NULL) {
+        // 解码后核对头部中的接收人信息
+        int result = decompress_file(input, output, code_file, receiver, encrypt);  // 调用解压缩函数
+        if (result == RESULT_RECEIVER_MISMATCH) {
             fprintf(stderr, "错误：接收人信息不匹配，解压终止\n");
-            fclose(temp);
             return 1;
         }
-        fclose(temp);
+        if (result != RESULT_OK)
+            return 1;
         printf("发送人信息：%s\n", sender);
         printf("接收人信息：%s\n", receiver);
-        decompress_file(input, output, code_file, encrypt);  // 调用解压缩函数
         printf("Decompression successful!\n");  // 打印解压缩成功信息
     } else {
         usage();  // 如果操作模式无效，打印使用说明
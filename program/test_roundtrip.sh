@@ -0,0 +1,79 @@
+#!/bin/sh
+# 批处理往返测试：批量压缩一个目录后再批量解压，逐个比对还原结果，并检查接收人不匹配时解压被拒绝
+set -e
+cd "$(dirname "$0")"
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+cc ${CFLAGS:--O2} -pthread -o "$work/program" *.c  # 可通过 CFLAGS 启用 -fsanitize=address,undefined 等检查
+
+sender=2023000001,Zhang
+receiver=2023000002,Wang
+
+mkdir "$work/data"
+cp *.c *.h "$work/data/"  # 含中文注释的源码，会产生超过 8 位的编码
+head -c 20000 /dev/urandom > "$work/data/random.bin"
+printf 'a' > "$work/data/one.txt"
+: > "$work/data/empty.txt"
+
+for option in "" encrypt; do
+    "$work/program" batch compress "$work/data" "$work/compress.tsv" "$sender" "$receiver" $option 4
+    "$work/program" batch decompress "$work/data" "$work/decompress.tsv" "$sender" "$receiver" $option 4
+    for file in "$work"/data/*; do
+        case "$file" in *.huf|*.code|*.out) continue ;; esac
+        if ! cmp -s "$file" "$file.out"; then
+            echo "往返结果不一致：$file ${option:-plain}" >&2
+            exit 1
+        fi
+    done
+
+    if "$work/program" batch decompress "$work/data" "$work/mismatch.tsv" "$sender" 2023000003,Li $option 4; then
+        echo "接收人不匹配时解压应当失败" >&2
+        exit 1
+    fi
+    if grep -v '^#' "$work/mismatch.tsv" | grep -qv '^receiver-mismatch'; then
+        echo "接收人不匹配的文件应标记为 receiver-mismatch" >&2
+        exit 1
+    fi
+    rm -f "$work"/data/*.huf "$work"/data/*.code "$work"/data/*.out
+done
+
+# 清单模式：注释行和空行被跳过，不存在的输入文件在汇总中标记为 failed 且退出码非零
+cp "$work/data/random.bin" "$work/listed.bin"
+cat > "$work/manifest.txt" <<EOF
+# 输入 输出 编码表
+
+$work/listed.bin $work/listed.huf $work/listed.code
+$work/missing.bin $work/missing.huf $work/missing.code
+EOF
+if "$work/program" batch compress "$work/manifest.txt" "$work/manifest.tsv" "$sender" "$receiver" 2; then
+    echo "清单中有不存在的输入文件时批处理应当失败" >&2
+    exit 1
+fi
+tab=$(printf '\t')
+if [ "$(grep -vc '^#' "$work/manifest.tsv")" -ne 2 ] ||
+   ! grep -q "^ok$tab$work/listed.bin$tab" "$work/manifest.tsv" ||
+   ! grep -q "^failed$tab$work/missing.bin$tab" "$work/manifest.tsv"; then
+    echo "清单模式的汇总结果不正确" >&2
+    exit 1
+fi
+echo "$work/listed.huf $work/listed.out $work/listed.code" > "$work/manifest.txt"
+"$work/program" batch decompress "$work/manifest.txt" "$work/manifest.tsv" "$sender" "$receiver" 2
+cmp "$work/listed.bin" "$work/listed.out"
+
+# 清单中格式错误的行使整个批处理在开始前失败
+echo "$work/listed.bin $work/listed.huf" > "$work/manifest.txt"
+if "$work/program" batch compress "$work/manifest.txt" "$work/manifest.tsv" "$sender" "$receiver" 2; then
+    echo "清单格式错误时批处理应当失败" >&2
+    exit 1
+fi
+
+# 空目录是合法输入，汇总文件只有表头
+mkdir "$work/empty"
+"$work/program" batch compress "$work/empty" "$work/empty.tsv" "$sender" "$receiver"
+if [ "$(grep -vc '^#' "$work/empty.tsv")" -ne 0 ]; then
+    echo "空目录的汇总文件应当只有表头" >&2
+    exit 1
+fi
+
+echo "往返测试通过"